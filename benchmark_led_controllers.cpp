@@ -0,0 +1,180 @@
+/*
+ * LED Controller Benchmark - compares the runtime LedController with the
+ * compile-time StaticLedController.
+ * Copy into src/ in place of main.cpp and upload. Results are printed over
+ * serial every few seconds.
+ *
+ * Status: not run on a board yet. Only host builds have been checked, so there
+ * are no numbers to quote and no claim that the static controller is faster.
+ * Recording ESP32 results in the README is an open follow-up.
+ *
+ * Timed:
+ *  - render() for the macro layout (4 groups x 1 LED) on both controllers
+ *  - render() for an uneven LedLayout against a runtime span-table loop, which
+ *    is what a runtime-configurable controller would have to do for it
+ *  - getGroup(int) against getGroup<N>()
+ *  - setGroupColor(int, ...) against setGroupColor<N>(...). These include
+ *    updateLeds(), so the serial status dump and FastLED.show() dominate; the
+ *    same work is done by both, so the difference is the index handling.
+ */
+
+#include <Arduino.h>
+#include "LedController.h"
+#include "StaticLedController.h"
+
+#define ITERATIONS 100000
+#define SETTER_ITERATIONS 100
+
+// Uneven installation: a pair, a pair and a strip of four
+typedef LedLayout<LED_PIN, GRB, 8, LedSpan<0, 2>, LedSpan<2, 2>, LedSpan<4, 4>> CaseLayout;
+
+struct RuntimeSpan
+{
+    int start;
+    int count;
+};
+
+const RuntimeSpan caseSpans[] = {{0, 2}, {2, 2}, {4, 4}};
+#define CASE_GROUPS 3
+#define CASE_LEDS 8
+
+LedController runtimeController;
+StaticLedController<FigurineLedLayout> staticController;
+StaticLedController<CaseLayout> staticCaseController;
+
+// Runtime equivalent of StaticLedController<CaseLayout>::render()
+LedGroup runtimeCaseGroups[CASE_GROUPS];
+CRGB runtimeCaseLeds[CASE_LEDS];
+
+// Keeps the compiler from dropping the loops
+volatile uint8_t sink;
+
+void renderRuntimeCase()
+{
+    for (int group = 0; group < CASE_GROUPS; group++)
+    {
+        CRGB color = CRGB::Black;
+        if (runtimeCaseGroups[group].isOn)
+        {
+            color = runtimeCaseGroups[group].color;
+            color.nscale8(runtimeCaseGroups[group].brightness);
+        }
+
+        for (int i = 0; i < caseSpans[group].count; i++)
+        {
+            runtimeCaseLeds[caseSpans[group].start + i] = color;
+        }
+    }
+}
+
+void printResult(const char *name, unsigned long runtimeUs, unsigned long staticUs, int iterations)
+{
+    Serial.printf("%-16s runtime %8lu us, static %8lu us (%.1f ns vs %.1f ns per call)\n",
+                  name, runtimeUs, staticUs,
+                  runtimeUs * 1000.0 / iterations, staticUs * 1000.0 / iterations);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("LED Controller Benchmark");
+    Serial.printf("Groups: %d, LEDs per group: %d, iterations: %d\n", NUM_GROUPS, LEDS_PER_GROUP, ITERATIONS);
+
+    // All controllers render into their own buffers; only one is attached to the strip
+    runtimeController.init();
+
+    for (int i = 0; i < NUM_GROUPS; i++)
+    {
+        runtimeController.setGroupColor(i, 255, 128, 64);
+        runtimeController.setGroupState(i, i % 2 == 0);
+        staticController.setGroupColor(i, 255, 128, 64);
+        staticController.setGroupState(i, i % 2 == 0);
+    }
+
+    for (int i = 0; i < CASE_GROUPS; i++)
+    {
+        runtimeCaseGroups[i].color = CRGB(255, 128, 64);
+        runtimeCaseGroups[i].brightness = 128;
+        runtimeCaseGroups[i].isOn = i % 2 == 0;
+        staticCaseController.setGroupColor(i, 255, 128, 64);
+        staticCaseController.setGroupState(i, i % 2 == 0);
+    }
+}
+
+void loop()
+{
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        runtimeController.render();
+        sink = runtimeController.leds[i % NUM_LEDS].r;
+    }
+    unsigned long runtimeRender = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        staticController.render();
+        sink = staticController.leds[i % NUM_LEDS].r;
+    }
+    unsigned long staticRender = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        renderRuntimeCase();
+        sink = runtimeCaseLeds[i % CASE_LEDS].r;
+    }
+    unsigned long runtimeCaseRender = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        staticCaseController.render();
+        sink = staticCaseController.leds[i % CASE_LEDS].r;
+    }
+    unsigned long staticCaseRender = micros() - start;
+
+    // Four reads per iteration so the static side can use constant indices
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        sink = runtimeController.getGroup(0).brightness;
+        sink = runtimeController.getGroup(1).brightness;
+        sink = runtimeController.getGroup(2).brightness;
+        sink = runtimeController.getGroup(3).brightness;
+    }
+    unsigned long runtimeGet = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        sink = staticController.getGroup<0>().brightness;
+        sink = staticController.getGroup<1>().brightness;
+        sink = staticController.getGroup<2>().brightness;
+        sink = staticController.getGroup<3>().brightness;
+    }
+    unsigned long staticGet = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < SETTER_ITERATIONS; i++)
+    {
+        runtimeController.setGroupColor(1, 255, 128, i);
+    }
+    unsigned long runtimeSet = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < SETTER_ITERATIONS; i++)
+    {
+        staticController.setGroupColor<1>(255, 128, i);
+    }
+    unsigned long staticSet = micros() - start;
+
+    printResult("render() 4x1", runtimeRender, staticRender, ITERATIONS);
+    printResult("render() 2/2/4", runtimeCaseRender, staticCaseRender, ITERATIONS);
+    printResult("getGroup() x4", runtimeGet, staticGet, ITERATIONS);
+    printResult("setGroupColor()", runtimeSet, staticSet, SETTER_ITERATIONS);
+
+    delay(5000);
+}
@@ -1,9 +1,14 @@
 #include "LedController.h"
 
-LedController::LedController()
+LedGroupController::LedGroupController(LedGroup *groups, int groupCount)
+    : groups(groups), groupCount(groupCount)
+{
+}
+
+void LedGroupController::resetGroups()
 {
     // Initialize groups with default values
-    for (int i = 0; i < NUM_GROUPS; i++)
+    for (int i = 0; i < groupCount; i++)
     {
         groups[i].color = CRGB::White;
         groups[i].brightness = 128; // 50% brightness
@@ -11,66 +16,57 @@ LedController::LedController()
     }
 }
 
-void LedController::init()
-{
-    Serial.println("Initializing FastLED with GRB color order...");
-    FastLED.addLeds<WS2812, LED_PIN, GRB>(leds, NUM_LEDS);
-    FastLED.setBrightness(255);
-    FastLED.clear();
-    FastLED.show();
-    Serial.println("FastLED initialization complete");
-}
-
-void LedController::updateLeds()
+void LedGroupController::printStatus()
 {
     Serial.print("updateLeds() called - Status: ");
-    for (int group = 0; group < NUM_GROUPS; group++)
+    for (int group = 0; group < groupCount; group++)
     {
-        int ledIndex = group; // Each group has 1 LED, so index = group number
-
         if (groups[group].isOn)
         {
-            CRGB color = groups[group].color;
-            // Apply brightness scaling
-            color.nscale8(groups[group].brightness);
-
             Serial.printf("G%d:ON(R%d,G%d,B%d,Br%d) ", group, groups[group].color.r, groups[group].color.g, groups[group].color.b, groups[group].brightness);
-
-            leds[ledIndex] = color;
         }
         else
         {
             Serial.printf("G%d:OFF ", group);
-            leds[ledIndex] = CRGB::Black;
         }
     }
     Serial.println();
+}
 
+bool LedGroupController::isValidGroup(int groupIndex) const
+{
+    return groupIndex >= 0 && groupIndex < groupCount;
+}
+
+void LedGroupController::updateLeds()
+{
+    printStatus();
+    render();
     FastLED.show();
     Serial.println("FastLED.show() called");
 }
 
-void LedController::setGroupColor(int groupIndex, uint8_t r, uint8_t g, uint8_t b)
+void LedGroupController::setGroupColor(int groupIndex, uint8_t r, uint8_t g, uint8_t b)
 {
-    if (groupIndex >= 0 && groupIndex < NUM_GROUPS)
+    if (isValidGroup(groupIndex))
     {
         groups[groupIndex].color = CRGB(r, g, b);
         updateLeds();
     }
 }
 
-void LedController::setGroupBrightness(int groupIndex, uint8_t brightness)
+void LedGroupController::setGroupBrightness(int groupIndex, uint8_t brightness)
 {
-    if (groupIndex >= 0 && groupIndex < NUM_GROUPS)
+    if (isValidGroup(groupIndex))
     {
         groups[groupIndex].brightness = brightness;
         updateLeds();
     }
 }
 
-void LedController::setGroupState(int groupIndex, bool state)
+void LedGroupController::setGroupState(int groupIndex, bool state)
 {
-    if (groupIndex >= 0 && groupIndex < NUM_GROUPS)
+    if (isValidGroup(groupIndex))
     {
         Serial.printf("setGroupState: Group %d -> %s\n", groupIndex, state ? "ON" : "OFF");
         groups[groupIndex].isOn = state;
@@ -82,71 +78,118 @@ void LedController::setGroupState(int groupIndex, bool state)
     }
 }
 
-void LedController::setAllOff()
+void LedGroupController::setGroups(const LedGroup *states, int count)
+{
+    // Applies several groups with a single show, so they change on the same frame.
+    // Used for synced scenes: the status dump can block on a full serial queue,
+    // so it comes after the show instead of before it as in updateLeds()
+    for (int i = 0; i < count && i < groupCount; i++)
+    {
+        groups[i] = states[i];
+    }
+    render();
+    FastLED.show();
+    printStatus();
+}
+
+void LedGroupController::setAllOff()
 {
     Serial.println("setAllOff: Turning off all groups");
-    for (int i = 0; i < NUM_GROUPS; i++)
+    for (int i = 0; i < groupCount; i++)
     {
         groups[i].isOn = false;
     }
     updateLeds();
 }
 
-void LedController::setAllOn()
+void LedGroupController::setAllOn()
 {
     Serial.println("setAllOn: Turning on all groups");
-    for (int i = 0; i < NUM_GROUPS; i++)
+    for (int i = 0; i < groupCount; i++)
     {
         groups[i].isOn = true;
     }
     updateLeds();
 }
 
-String LedController::getGroupStatus(int groupIndex)
+String groupStatusJson(int groupIndex, const LedGroup &group)
 {
-    if (groupIndex < 0 || groupIndex >= NUM_GROUPS)
-    {
-        return "{}";
-    }
-
     String result = "{\"group\":" + String(groupIndex);
-    result += ",\"isOn\":" + String(groups[groupIndex].isOn ? "true" : "false");
-    result += ",\"brightness\":" + String(groups[groupIndex].brightness);
+    result += ",\"isOn\":" + String(group.isOn ? "true" : "false");
+    result += ",\"brightness\":" + String(group.brightness);
     result += ",\"color\":{";
-    result += "\"r\":" + String(groups[groupIndex].color.r);
-    result += ",\"g\":" + String(groups[groupIndex].color.g);
-    result += ",\"b\":" + String(groups[groupIndex].color.b);
+    result += "\"r\":" + String(group.color.r);
+    result += ",\"g\":" + String(group.color.g);
+    result += ",\"b\":" + String(group.color.b);
     result += "}}";
     return result;
 }
 
-String LedController::getAllStatus()
+String LedGroupController::getGroupStatus(int groupIndex)
+{
+    if (!isValidGroup(groupIndex))
+    {
+        return "{}";
+    }
+
+    return groupStatusJson(groupIndex, groups[groupIndex]);
+}
+
+String LedGroupController::getAllStatus()
 {
     String result = "{\"groups\":[";
 
-    for (int i = 0; i < NUM_GROUPS; i++)
+    for (int i = 0; i < groupCount; i++)
     {
         if (i > 0)
             result += ",";
-        result += "{\"group\":" + String(i);
-        result += ",\"isOn\":" + String(groups[i].isOn ? "true" : "false");
-        result += ",\"brightness\":" + String(groups[i].brightness);
-        result += ",\"color\":{";
-        result += "\"r\":" + String(groups[i].color.r);
-        result += ",\"g\":" + String(groups[i].color.g);
-        result += ",\"b\":" + String(groups[i].color.b);
-        result += "}}";
+        result += groupStatusJson(i, groups[i]);
     }
 
     result += "]}";
     return result;
 }
 
+LedController::LedController()
+    : LedGroupController(groupStates, NUM_GROUPS)
+{
+    resetGroups();
+}
+
+void LedController::init()
+{
+    Serial.println("Initializing FastLED with GRB color order...");
+    FastLED.addLeds<WS2812, LED_PIN, GRB>(leds, NUM_LEDS);
+    FastLED.setBrightness(255);
+    FastLED.clear();
+    FastLED.show();
+    Serial.println("FastLED initialization complete");
+}
+
+void LedController::render()
+{
+    for (int group = 0; group < NUM_GROUPS; group++)
+    {
+        CRGB color = CRGB::Black;
+        if (groupStates[group].isOn)
+        {
+            color = groupStates[group].color;
+            // Apply brightness scaling
+            color.nscale8(groupStates[group].brightness);
+        }
+
+        for (int i = 0; i < LEDS_PER_GROUP; i++)
+        {
+            leds[group * LEDS_PER_GROUP + i] = color;
+        }
+    }
+}
+
 LedGroup LedController::getGroup(int groupIndex)
 {
-    if (groupIndex >= 0 && groupIndex < NUM_GROUPS)
+    if (isValidGroup(groupIndex))
     {
-        return groups[groupIndex];
+        return groupStates[groupIndex];
     }
     return LedGroup();
-}
\ No newline at end of file
+}
@@ -9,6 +9,9 @@
 #define NUM_GROUPS 4
 #define LEDS_PER_GROUP 1
 
+// Both controllers render NUM_GROUPS spans of LEDS_PER_GROUP into the strip
+static_assert(NUM_LEDS == NUM_GROUPS * LEDS_PER_GROUP, "NUM_LEDS must equal NUM_GROUPS * LEDS_PER_GROUP");
+
 struct LedGroup
 {
     CRGB color;
@@ -16,25 +19,52 @@ struct LedGroup
     bool isOn;
 };
 
-class LedController
+// Serializes a single group as the JSON object used by the status API
+String groupStatusJson(int groupIndex, const LedGroup &group);
+
+// Group state and everything done with it that does not depend on how the
+// groups map onto the strip. Controllers own the storage and supply render().
+class LedGroupController
 {
-public:
-    CRGB leds[NUM_LEDS]; // Make public for direct testing
+protected:
+    LedGroup *groups;
+    int groupCount;
 
-private:
-    LedGroup groups[NUM_GROUPS];
+    LedGroupController(LedGroup *groups, int groupCount);
+    void resetGroups();
+    void printStatus();
+    bool isValidGroup(int groupIndex) const;
 
 public:
-    LedController();
-    void init();
+    virtual void render() = 0;
     void updateLeds();
     void setGroupColor(int groupIndex, uint8_t r, uint8_t g, uint8_t b);
     void setGroupBrightness(int groupIndex, uint8_t brightness);
     void setGroupState(int groupIndex, bool state);
+    void setGroups(const LedGroup *states, int count);
     void setAllOff();
     void setAllOn();
     String getGroupStatus(int groupIndex);
     String getAllStatus();
+};
+
+// Groups of LEDS_PER_GROUP consecutive LEDs, laid out by the macros above
+class LedController final : public LedGroupController
+{
+public:
+    static constexpr int ledPin = LED_PIN;
+    static constexpr int numLeds = NUM_LEDS;
+    static constexpr int numGroups = NUM_GROUPS;
+
+    CRGB leds[NUM_LEDS]; // Make public for direct testing
+
+private:
+    LedGroup groupStates[NUM_GROUPS];
+
+public:
+    LedController();
+    void init();
+    void render() override;
     LedGroup getGroup(int groupIndex);
 };
 
@@ -0,0 +1,187 @@
+#ifndef STATIC_LED_CONTROLLER_H
+#define STATIC_LED_CONTROLLER_H
+
+#include <type_traits>
+#include <FastLED.h>
+#include "LedController.h"
+
+// A contiguous run of LEDs driven by one group
+template <int Start, int Count>
+struct LedSpan
+{
+    static constexpr int start = Start;
+    static constexpr int count = Count;
+};
+
+// Picks the Index-th span out of a span list
+template <int Index, typename First, typename... Rest>
+struct LedSpanAt : LedSpanAt<Index - 1, Rest...>
+{
+};
+
+template <typename First, typename... Rest>
+struct LedSpanAt<0, First, Rest...> : First
+{
+};
+
+// Fixed installation layout with an explicit span per group, e.g.
+//   LedLayout<18, GRB, 8, LedSpan<0, 2>, LedSpan<2, 2>, LedSpan<4, 4>>
+template <uint8_t Pin, EOrder Order, int NumLeds, typename... Spans>
+struct LedLayout
+{
+    static constexpr uint8_t pin = Pin;
+    static constexpr EOrder colorOrder = Order;
+    static constexpr int numLeds = NumLeds;
+    static constexpr int numGroups = sizeof...(Spans);
+
+    template <int Group>
+    struct Span : LedSpanAt<Group, Spans...>
+    {
+    };
+};
+
+// Fixed installation layout where every group drives the same number of LEDs
+template <uint8_t Pin, EOrder Order, int NumGroups, int LedsPerGroup>
+struct UniformLedLayout
+{
+    static constexpr uint8_t pin = Pin;
+    static constexpr EOrder colorOrder = Order;
+    static constexpr int numLeds = NumGroups * LedsPerGroup;
+    static constexpr int numGroups = NumGroups;
+
+    template <int Group>
+    struct Span : LedSpan<Group * LedsPerGroup, LedsPerGroup>
+    {
+    };
+};
+
+// The layout described by the macros in LedController.h
+typedef UniformLedLayout<LED_PIN, GRB, NUM_GROUPS, LEDS_PER_GROUP> FigurineLedLayout;
+
+// LedController with the layout fixed at compile time. Pin, color order, LED
+// count and group spans come from Layout, so render() unrolls into straight-line
+// stores and the templated accessors reject bad group indices at compile time.
+// Everything else, including the int-indexed setters that keep the runtime
+// bounds check for API input, is shared with LedController.
+template <typename Layout>
+class StaticLedController final : public LedGroupController
+{
+public:
+    static constexpr int ledPin = Layout::pin;
+    static constexpr int numLeds = Layout::numLeds;
+    static constexpr int numGroups = Layout::numGroups;
+
+    CRGB leds[numLeds]; // Make public for direct testing
+
+private:
+    LedGroup groupStates[numGroups];
+
+    template <int Group>
+    static void checkGroup()
+    {
+        static_assert(Group >= 0 && Group < numGroups, "group index out of range for this layout");
+    }
+
+    // Start is where the previous span ended, so the layout has to tile the
+    // strip: no gaps, no overlaps and no LEDs left over at the end
+    template <int Group, int Start>
+    void renderGroup(std::integral_constant<int, Group>, std::integral_constant<int, Start>)
+    {
+        typedef typename Layout::template Span<Group> Span;
+        static_assert(Span::start == Start, "group span must start where the previous one ends");
+        static_assert(Span::count > 0, "group span must contain at least one LED");
+        static_assert(Span::start + Span::count <= numLeds, "group span does not fit in the LED strip");
+
+        CRGB color = CRGB::Black;
+        if (groupStates[Group].isOn)
+        {
+            color = groupStates[Group].color;
+            // Apply brightness scaling
+            color.nscale8(groupStates[Group].brightness);
+        }
+
+        for (int i = 0; i < Span::count; i++)
+        {
+            leds[Span::start + i] = color;
+        }
+
+        renderGroup(std::integral_constant<int, Group + 1>(), std::integral_constant<int, Span::start + Span::count>());
+    }
+
+    template <int End>
+    void renderGroup(std::integral_constant<int, numGroups>, std::integral_constant<int, End>)
+    {
+        static_assert(End == numLeds, "group spans leave LEDs at the end of the strip unused");
+    }
+
+public:
+    StaticLedController()
+        : LedGroupController(groupStates, numGroups)
+    {
+        resetGroups();
+    }
+
+    void init()
+    {
+        Serial.println("Initializing FastLED with fixed layout...");
+        FastLED.addLeds<WS2812, Layout::pin, Layout::colorOrder>(leds, numLeds);
+        FastLED.setBrightness(255);
+        FastLED.clear();
+        FastLED.show();
+        Serial.println("FastLED initialization complete");
+    }
+
+    void render() override
+    {
+        renderGroup(std::integral_constant<int, 0>(), std::integral_constant<int, 0>());
+    }
+
+    // Compile-time checked group access
+
+    using LedGroupController::setGroupColor;
+    using LedGroupController::setGroupBrightness;
+    using LedGroupController::setGroupState;
+
+    template <int Group>
+    void setGroupColor(uint8_t r, uint8_t g, uint8_t b)
+    {
+        checkGroup<Group>();
+        groupStates[Group].color = CRGB(r, g, b);
+        updateLeds();
+    }
+
+    template <int Group>
+    void setGroupBrightness(uint8_t brightness)
+    {
+        checkGroup<Group>();
+        groupStates[Group].brightness = brightness;
+        updateLeds();
+    }
+
+    template <int Group>
+    void setGroupState(bool state)
+    {
+        checkGroup<Group>();
+        groupStates[Group].isOn = state;
+        updateLeds();
+    }
+
+    template <int Group>
+    const LedGroup &getGroup() const
+    {
+        checkGroup<Group>();
+        return groupStates[Group];
+    }
+
+    const LedGroup &getGroup(int groupIndex) const
+    {
+        static const LedGroup emptyGroup = LedGroup();
+        if (isValidGroup(groupIndex))
+        {
+            return groupStates[groupIndex];
+        }
+        return emptyGroup;
+    }
+};
+
+#endif
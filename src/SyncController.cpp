@@ -0,0 +1,244 @@
+#include "SyncController.h"
+#include <esp_timer.h>
+
+SyncController::SyncController()
+{
+    onScene = NULL;
+    active = false;
+    hasLeaderAddress = false;
+    leaderPort = 0;
+    lastTimeRequest = 0;
+    lastHeartbeat = 0;
+}
+
+void SyncController::begin(SyncRole role, SyncSceneCallback callback)
+{
+    stop();
+    onScene = callback;
+
+    if (role == SYNC_OFF)
+    {
+        Serial.println("Sync disabled");
+        return;
+    }
+
+    if (!udp.beginMulticast(SYNC_MULTICAST_GROUP, SYNC_MULTICAST_PORT))
+    {
+        Serial.println("Sync: failed to join multicast group");
+        return;
+    }
+
+    // Modem sleep delays packets by up to a beacon interval, which ruins clock samples
+    WiFi.setSleep(false);
+
+    uint32_t session = esp_random();
+    if (session == 0)
+    {
+        session = 1;
+    }
+    node.begin(role, session);
+    active = true;
+    Serial.printf("Sync started as %s (session %08x)\n", syncRoleName(role), session);
+}
+
+void SyncController::stop()
+{
+    if (active)
+    {
+        udp.stop();
+    }
+    node.begin(SYNC_OFF, 0);
+    active = false;
+    hasLeaderAddress = false;
+    lastTimeRequest = 0;
+    lastHeartbeat = 0;
+}
+
+SyncRole SyncController::getRole() const
+{
+    return active ? node.getRole() : SYNC_OFF;
+}
+
+bool SyncController::isLeader() const
+{
+    return getRole() == SYNC_LEADER;
+}
+
+bool SyncController::getLatestScene(SyncScene &scene) const
+{
+    return active && node.getLatestScene(scene);
+}
+
+void SyncController::publish(const SyncScene &scene)
+{
+    uint8_t buf[SYNC_MAX_MESSAGE_SIZE];
+    size_t size = node.publish(scene, esp_timer_get_time(), buf, sizeof(buf));
+    if (size == 0)
+    {
+        return;
+    }
+
+    udp.beginMulticastPacket();
+    udp.write(buf, size);
+    udp.endPacket();
+    lastHeartbeat = esp_timer_get_time();
+    Serial.printf("Sync: published scene %u\n", node.getLatestSeq());
+}
+
+void SyncController::service()
+{
+    uint8_t buf[SYNC_MAX_MESSAGE_SIZE];
+    uint8_t reply[SYNC_MAX_MESSAGE_SIZE];
+
+    int packetSize;
+    while ((packetSize = udp.parsePacket()) > 0)
+    {
+        int64_t now = esp_timer_get_time();
+        int len = udp.read(buf, sizeof(buf));
+        if (len <= 0)
+        {
+            continue;
+        }
+
+        size_t replySize = node.handleMessage(buf, len, now, reply, sizeof(reply));
+        if (replySize > 0)
+        {
+            udp.beginPacket(udp.remoteIP(), udp.remotePort());
+            udp.write(reply, replySize);
+            udp.endPacket();
+        }
+
+        // Clock samples are requested from whoever sends the scenes
+        SyncMessage msg;
+        if (node.getRole() == SYNC_FOLLOWER && decodeSyncMessage(buf, len, msg) && msg.type == SYNC_MSG_SCENE)
+        {
+            leaderIP = udp.remoteIP();
+            leaderPort = udp.remotePort();
+            hasLeaderAddress = true;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (node.getRole() == SYNC_FOLLOWER && hasLeaderAddress)
+    {
+        int64_t interval = node.getClock().sampleCount() < SYNC_OFFSET_SAMPLES ? SYNC_TIME_REQUEST_FAST_US : SYNC_TIME_REQUEST_US;
+        if (now - lastTimeRequest >= interval)
+        {
+            size_t size = node.makeTimeRequest(now, buf, sizeof(buf));
+            udp.beginPacket(leaderIP, leaderPort);
+            udp.write(buf, size);
+            udp.endPacket();
+            lastTimeRequest = now;
+        }
+    }
+    else if (node.getRole() == SYNC_LEADER && now - lastHeartbeat >= SYNC_HEARTBEAT_US)
+    {
+        size_t size = node.makeHeartbeat(buf, sizeof(buf));
+        if (size > 0)
+        {
+            udp.beginMulticastPacket();
+            udp.write(buf, size);
+            udp.endPacket();
+        }
+        lastHeartbeat = now;
+    }
+}
+
+void SyncController::applyDueScene()
+{
+    SyncScene scene;
+    uint32_t frame;
+    int64_t lateness;
+    if (!node.takeDueScene(esp_timer_get_time(), scene, frame, lateness))
+    {
+        return;
+    }
+
+    if (onScene != NULL)
+    {
+        onScene(scene);
+    }
+
+    if (lateness >= SYNC_FRAME_US)
+    {
+        Serial.printf("Sync: scene %u applied %lld us after its frame (%u late so far)\n",
+                      node.getLatestSeq(), (long long)lateness, node.getLateApplies());
+    }
+}
+
+void SyncController::wait(unsigned long ms)
+{
+    if (!active)
+    {
+        delay(ms);
+        return;
+    }
+
+    // Same as delay(), but keeps servicing packets and applies a due scene
+    // on the exact frame start instead of whenever the main loop comes round
+    int64_t end = esp_timer_get_time() + (int64_t)ms * 1000;
+    int64_t now;
+    do
+    {
+        service();
+        int64_t dueIn = node.pendingDueIn(esp_timer_get_time());
+        if (dueIn >= 0 && dueIn <= 1000)
+        {
+            delayMicroseconds(dueIn);
+            applyDueScene();
+        }
+        else
+        {
+            delay(1);
+        }
+        now = esp_timer_get_time();
+    } while (now < end);
+}
+
+String SyncController::getStatus()
+{
+    SyncRole role = getRole();
+    const ClockOffsetEstimator &clock = node.getClock();
+    char buf[320];
+
+    snprintf(buf, sizeof(buf),
+             "{\"role\":\"%s\",\"session\":%u,\"clockReady\":%s,\"offsetUs\":%lld,\"roundTripUs\":%lld,\"samples\":%d,\"latestSeq\":%u,\"lateApplies\":%u,\"lastLateUs\":%lld,\"leadFrames\":%d,\"leader\":\"%s\"}",
+             syncRoleName(role),
+             node.getSession(),
+             node.isClockReady() ? "true" : "false",
+             (long long)clock.offset(),
+             (long long)clock.roundTrip(),
+             clock.sampleCount(),
+             node.getLatestSeq(),
+             node.getLateApplies(),
+             (long long)node.getLastLateness(),
+             SYNC_LEAD_FRAMES,
+             hasLeaderAddress ? leaderIP.toString().c_str() : "");
+    return String(buf);
+}
+
+const char *syncRoleName(SyncRole role)
+{
+    switch (role)
+    {
+    case SYNC_LEADER:
+        return "leader";
+    case SYNC_FOLLOWER:
+        return "follower";
+    default:
+        return "off";
+    }
+}
+
+bool syncRoleFromName(const String &name, SyncRole &role)
+{
+    if (name == "leader")
+        role = SYNC_LEADER;
+    else if (name == "follower")
+        role = SYNC_FOLLOWER;
+    else if (name == "off")
+        role = SYNC_OFF;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SYNC_CONTROLLER_H
+#define SYNC_CONTROLLER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "SyncProtocol.h"
+
+#define SYNC_MULTICAST_GROUP IPAddress(239, 255, 70, 76)
+
+typedef void (*SyncSceneCallback)(const SyncScene &scene);
+
+// Runs a SyncNode over UDP multicast. Scenes are handed to the callback on
+// the frame the leader scheduled them for, on the leader as well as on every
+// follower, so all boards change together.
+class SyncController
+{
+private:
+    WiFiUDP udp;
+    SyncNode node;
+    SyncSceneCallback onScene;
+    bool active;
+    bool hasLeaderAddress;
+    IPAddress leaderIP;
+    uint16_t leaderPort;
+    int64_t lastTimeRequest;
+    int64_t lastHeartbeat;
+
+    void service();
+    void applyDueScene();
+
+public:
+    SyncController();
+    void begin(SyncRole role, SyncSceneCallback callback);
+    void stop();
+    SyncRole getRole() const;
+    bool isLeader() const;
+    bool getLatestScene(SyncScene &scene) const;
+    void publish(const SyncScene &scene);
+    void wait(unsigned long ms);
+    String getStatus();
+};
+
+const char *syncRoleName(SyncRole role);
+bool syncRoleFromName(const String &name, SyncRole &role);
+
+#endif
@@ -0,0 +1,413 @@
+#include "SyncProtocol.h"
+
+#define SYNC_HEADER_SIZE 8
+#define SYNC_GROUP_SIZE 5
+
+// Wire format is little-endian regardless of host
+
+static void putU16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static void putI64(uint8_t *p, int64_t v)
+{
+    uint64_t u = (uint64_t)v;
+    for (int i = 0; i < 8; i++)
+        p[i] = (u >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static int64_t getI64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return (int64_t)v;
+}
+
+static void putHeader(uint8_t *buf, uint8_t type, uint32_t session)
+{
+    putU16(buf, SYNC_MAGIC);
+    buf[2] = SYNC_VERSION;
+    buf[3] = type;
+    putU32(buf + 4, session);
+}
+
+size_t encodeSyncScene(uint8_t *buf, size_t len, uint32_t session, uint32_t seq, uint32_t frame, const SyncScene &scene)
+{
+    if (scene.groupCount > SYNC_MAX_GROUPS)
+    {
+        return 0;
+    }
+
+    size_t size = SYNC_HEADER_SIZE + 9 + scene.groupCount * SYNC_GROUP_SIZE;
+    if (len < size)
+    {
+        return 0;
+    }
+
+    putHeader(buf, SYNC_MSG_SCENE, session);
+    putU32(buf + 8, seq);
+    putU32(buf + 12, frame);
+    buf[16] = scene.groupCount;
+
+    uint8_t *p = buf + 17;
+    for (int i = 0; i < scene.groupCount; i++)
+    {
+        p[0] = scene.groups[i].r;
+        p[1] = scene.groups[i].g;
+        p[2] = scene.groups[i].b;
+        p[3] = scene.groups[i].brightness;
+        p[4] = scene.groups[i].isOn ? 1 : 0;
+        p += SYNC_GROUP_SIZE;
+    }
+    return size;
+}
+
+size_t encodeSyncTimeRequest(uint8_t *buf, size_t len, uint32_t session, int64_t t0)
+{
+    size_t size = SYNC_HEADER_SIZE + 8;
+    if (len < size)
+    {
+        return 0;
+    }
+
+    putHeader(buf, SYNC_MSG_TIME_REQUEST, session);
+    putI64(buf + 8, t0);
+    return size;
+}
+
+size_t encodeSyncTimeResponse(uint8_t *buf, size_t len, uint32_t session, int64_t t0, int64_t t1, int64_t t2)
+{
+    size_t size = SYNC_HEADER_SIZE + 24;
+    if (len < size)
+    {
+        return 0;
+    }
+
+    putHeader(buf, SYNC_MSG_TIME_RESPONSE, session);
+    putI64(buf + 8, t0);
+    putI64(buf + 16, t1);
+    putI64(buf + 24, t2);
+    return size;
+}
+
+bool decodeSyncMessage(const uint8_t *buf, size_t len, SyncMessage &msg)
+{
+    if (len < SYNC_HEADER_SIZE || getU16(buf) != SYNC_MAGIC || buf[2] != SYNC_VERSION)
+    {
+        return false;
+    }
+
+    msg.type = buf[3];
+    msg.session = getU32(buf + 4);
+
+    switch (msg.type)
+    {
+    case SYNC_MSG_SCENE:
+        if (len < SYNC_HEADER_SIZE + 9)
+            return false;
+        msg.seq = getU32(buf + 8);
+        msg.frame = getU32(buf + 12);
+        msg.scene.groupCount = buf[16];
+        if (msg.scene.groupCount > SYNC_MAX_GROUPS || len < SYNC_HEADER_SIZE + 9 + (size_t)msg.scene.groupCount * SYNC_GROUP_SIZE)
+            return false;
+        for (int i = 0; i < msg.scene.groupCount; i++)
+        {
+            const uint8_t *p = buf + 17 + i * SYNC_GROUP_SIZE;
+            msg.scene.groups[i].r = p[0];
+            msg.scene.groups[i].g = p[1];
+            msg.scene.groups[i].b = p[2];
+            msg.scene.groups[i].brightness = p[3];
+            msg.scene.groups[i].isOn = p[4] != 0;
+        }
+        return true;
+
+    case SYNC_MSG_TIME_REQUEST:
+        if (len < SYNC_HEADER_SIZE + 8)
+            return false;
+        msg.t0 = getI64(buf + 8);
+        return true;
+
+    case SYNC_MSG_TIME_RESPONSE:
+        if (len < SYNC_HEADER_SIZE + 24)
+            return false;
+        msg.t0 = getI64(buf + 8);
+        msg.t1 = getI64(buf + 16);
+        msg.t2 = getI64(buf + 24);
+        return true;
+    }
+
+    return false;
+}
+
+ClockOffsetEstimator::ClockOffsetEstimator()
+{
+    reset();
+}
+
+void ClockOffsetEstimator::reset()
+{
+    count = 0;
+    next = 0;
+    best = 0;
+}
+
+void ClockOffsetEstimator::addSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3)
+{
+    int64_t roundTrip = (t3 - t0) - (t2 - t1);
+    if (roundTrip < 0)
+    {
+        return;
+    }
+
+    offsets[next] = ((t1 - t0) + (t2 - t3)) / 2;
+    roundTrips[next] = roundTrip;
+    next = (next + 1) % SYNC_OFFSET_SAMPLES;
+    if (count < SYNC_OFFSET_SAMPLES)
+    {
+        count++;
+    }
+
+    best = 0;
+    for (int i = 1; i < count; i++)
+    {
+        if (roundTrips[i] < roundTrips[best])
+        {
+            best = i;
+        }
+    }
+}
+
+bool ClockOffsetEstimator::hasEstimate() const
+{
+    return count > 0;
+}
+
+int ClockOffsetEstimator::sampleCount() const
+{
+    return count;
+}
+
+int64_t ClockOffsetEstimator::offset() const
+{
+    return count > 0 ? offsets[best] : 0;
+}
+
+int64_t ClockOffsetEstimator::roundTrip() const
+{
+    return count > 0 ? roundTrips[best] : 0;
+}
+
+SyncNode::SyncNode()
+{
+    begin(SYNC_OFF, 0);
+}
+
+void SyncNode::begin(SyncRole newRole, uint32_t newSession)
+{
+    role = newRole;
+    session = newSession;
+    nextSeq = 1;
+    clock.reset();
+    hasLeader = false;
+    leaderSession = 0;
+    hasScene = false;
+    hasSceneSeq = false;
+    pending = false;
+    lateApplies = 0;
+    lastLateness = 0;
+}
+
+SyncRole SyncNode::getRole() const
+{
+    return role;
+}
+
+uint32_t SyncNode::getSession() const
+{
+    return session;
+}
+
+const ClockOffsetEstimator &SyncNode::getClock() const
+{
+    return clock;
+}
+
+bool SyncNode::isClockReady() const
+{
+    return role == SYNC_LEADER || (role == SYNC_FOLLOWER && clock.hasEstimate());
+}
+
+bool SyncNode::getLatestScene(SyncScene &latest) const
+{
+    if (!hasScene)
+    {
+        return false;
+    }
+    latest = scene;
+    return true;
+}
+
+uint32_t SyncNode::getLatestSeq() const
+{
+    return hasScene ? sceneSeq : 0;
+}
+
+uint32_t SyncNode::getLateApplies() const
+{
+    return lateApplies;
+}
+
+int64_t SyncNode::getLastLateness() const
+{
+    return lastLateness;
+}
+
+int64_t SyncNode::frameStartLocal(uint32_t frame) const
+{
+    int64_t leaderTime = (int64_t)frame * SYNC_FRAME_US;
+    return role == SYNC_FOLLOWER ? leaderTime - clock.offset() : leaderTime;
+}
+
+size_t SyncNode::publish(const SyncScene &newScene, int64_t now, uint8_t *buf, size_t len)
+{
+    if (role != SYNC_LEADER)
+    {
+        return 0;
+    }
+
+    scene = newScene;
+    sceneSession = session;
+    sceneSeq = nextSeq++;
+    sceneFrame = (uint32_t)(now / SYNC_FRAME_US) + 1 + SYNC_LEAD_FRAMES;
+    hasScene = true;
+    pending = true;
+
+    return encodeSyncScene(buf, len, session, sceneSeq, sceneFrame, scene);
+}
+
+size_t SyncNode::makeHeartbeat(uint8_t *buf, size_t len) const
+{
+    if (role != SYNC_LEADER || !hasScene)
+    {
+        return 0;
+    }
+    return encodeSyncScene(buf, len, session, sceneSeq, sceneFrame, scene);
+}
+
+size_t SyncNode::makeTimeRequest(int64_t now, uint8_t *buf, size_t len) const
+{
+    if (role != SYNC_FOLLOWER)
+    {
+        return 0;
+    }
+    return encodeSyncTimeRequest(buf, len, session, now);
+}
+
+size_t SyncNode::handleMessage(const uint8_t *data, size_t dataLen, int64_t now, uint8_t *reply, size_t replyLen)
+{
+    SyncMessage msg;
+    if (!decodeSyncMessage(data, dataLen, msg) || msg.session == session)
+    {
+        return 0;
+    }
+
+    if (role == SYNC_LEADER && msg.type == SYNC_MSG_TIME_REQUEST)
+    {
+        // Replying straight away, so receive and send time are the same
+        return encodeSyncTimeResponse(reply, replyLen, session, msg.t0, now, now);
+    }
+
+    if (role != SYNC_FOLLOWER)
+    {
+        return 0;
+    }
+
+    if (msg.type == SYNC_MSG_SCENE)
+    {
+        if (!hasLeader || msg.session != leaderSession)
+        {
+            // New or restarted leader, its clock has nothing to do with the old one
+            hasLeader = true;
+            leaderSession = msg.session;
+            hasSceneSeq = false;
+            clock.reset();
+        }
+
+        // Multicast can reorder, and heartbeats repeat the latest scene, so only
+        // a scene newer than everything seen from this leader replaces the held one
+        if (!hasSceneSeq || msg.seq > sceneSeq)
+        {
+            hasSceneSeq = true;
+            scene = msg.scene;
+            sceneSession = msg.session;
+            sceneSeq = msg.seq;
+            sceneFrame = msg.frame;
+            hasScene = true;
+            pending = true;
+        }
+    }
+    else if (msg.type == SYNC_MSG_TIME_RESPONSE)
+    {
+        if (hasLeader && msg.session == leaderSession)
+        {
+            clock.addSample(msg.t0, msg.t1, msg.t2, now);
+        }
+    }
+
+    return 0;
+}
+
+int64_t SyncNode::pendingDueIn(int64_t now) const
+{
+    if (!pending || !isClockReady())
+    {
+        return -1;
+    }
+
+    int64_t dueIn = frameStartLocal(sceneFrame) - now;
+    return dueIn > 0 ? dueIn : 0;
+}
+
+bool SyncNode::takeDueScene(int64_t now, SyncScene &due, uint32_t &frame, int64_t &lateness)
+{
+    if (pendingDueIn(now) != 0)
+    {
+        return false;
+    }
+
+    due = scene;
+    frame = sceneFrame;
+    pending = false;
+
+    // Arrived or got its clock estimate too late to start on its frame, so this
+    // board is out of step with the others for this scene
+    lateness = now - frameStartLocal(sceneFrame);
+    if (lateness >= SYNC_FRAME_US)
+    {
+        lateApplies++;
+        lastLateness = lateness;
+    }
+    return true;
+}
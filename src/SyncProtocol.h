@@ -0,0 +1,158 @@
+#ifndef SYNC_PROTOCOL_H
+#define SYNC_PROTOCOL_H
+
+// Leader/follower scene sync shared by several boards. This file has no
+// Arduino dependencies so the protocol can also be run on a desktop host
+// (see sync_loopback_test.cpp). All timestamps are microseconds.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SYNC_MULTICAST_PORT 4210
+#define SYNC_MAGIC 0x464C // "FL"
+#define SYNC_VERSION 1
+#define SYNC_MAX_GROUPS 8
+#define SYNC_MAX_MESSAGE_SIZE 64
+#define SYNC_FRAME_US 20000              // Frame grid scenes are scheduled on
+// Frames between publishing and applying a scene. Has to cover multicast
+// delivery, which access points can hold back by 100 ms or more; override
+// with -DSYNC_LEAD_FRAMES=n on the leader if scenes are reported late
+#ifndef SYNC_LEAD_FRAMES
+#define SYNC_LEAD_FRAMES 10
+#endif
+#define SYNC_OFFSET_SAMPLES 8            // Clock samples kept by the min-delay filter
+#define SYNC_TIME_REQUEST_US 1000000     // Follower clock sample interval once settled
+#define SYNC_TIME_REQUEST_FAST_US 100000 // Interval while the sample window fills up
+#define SYNC_HEARTBEAT_US 1000000        // Leader re-sends its latest scene this often
+
+enum SyncRole
+{
+    SYNC_OFF,
+    SYNC_LEADER,
+    SYNC_FOLLOWER
+};
+
+enum SyncMessageType
+{
+    SYNC_MSG_SCENE = 1,
+    SYNC_MSG_TIME_REQUEST = 2,
+    SYNC_MSG_TIME_RESPONSE = 3
+};
+
+struct SyncGroupState
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t brightness;
+    bool isOn;
+};
+
+struct SyncScene
+{
+    uint8_t groupCount;
+    SyncGroupState groups[SYNC_MAX_GROUPS];
+};
+
+struct SyncMessage
+{
+    uint8_t type;
+    uint32_t session; // Random per boot, lets followers notice a restarted leader
+
+    // SYNC_MSG_SCENE
+    uint32_t seq;
+    uint32_t frame;
+    SyncScene scene;
+
+    // SYNC_MSG_TIME_REQUEST / SYNC_MSG_TIME_RESPONSE
+    int64_t t0; // Follower send time
+    int64_t t1; // Leader receive time
+    int64_t t2; // Leader send time
+};
+
+size_t encodeSyncScene(uint8_t *buf, size_t len, uint32_t session, uint32_t seq, uint32_t frame, const SyncScene &scene);
+size_t encodeSyncTimeRequest(uint8_t *buf, size_t len, uint32_t session, int64_t t0);
+size_t encodeSyncTimeResponse(uint8_t *buf, size_t len, uint32_t session, int64_t t0, int64_t t1, int64_t t2);
+bool decodeSyncMessage(const uint8_t *buf, size_t len, SyncMessage &msg);
+
+// NTP-style offset estimation. Each request/response exchange gives an
+// offset and a round trip; the sample with the smallest round trip in the
+// window is the one least distorted by queueing, so that one is used.
+class ClockOffsetEstimator
+{
+private:
+    int64_t offsets[SYNC_OFFSET_SAMPLES];
+    int64_t roundTrips[SYNC_OFFSET_SAMPLES];
+    int count;
+    int next;
+    int best;
+
+public:
+    ClockOffsetEstimator();
+    void reset();
+    void addSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3);
+    bool hasEstimate() const;
+    int sampleCount() const;
+    int64_t offset() const; // Leader clock minus local clock
+    int64_t roundTrip() const;
+};
+
+// Transport-independent leader/follower state. The caller owns the socket
+// and the clock: it passes in received datagrams and the current local time,
+// and sends whatever buffers this class fills in.
+class SyncNode
+{
+private:
+    SyncRole role;
+    uint32_t session;
+    uint32_t nextSeq;
+    ClockOffsetEstimator clock;
+
+    // Follower: leader currently being tracked
+    bool hasLeader;
+    uint32_t leaderSession;
+
+    // Latest scene published (leader) or received (follower). sceneSeq is the
+    // highest seq seen from the current leader session once hasSceneSeq is set
+    bool hasScene;
+    bool hasSceneSeq;
+    bool pending;
+    uint32_t sceneSession;
+    uint32_t sceneSeq;
+    uint32_t sceneFrame;
+    SyncScene scene;
+
+    // Scenes applied after the frame they were scheduled for had already ended
+    uint32_t lateApplies;
+    int64_t lastLateness;
+
+public:
+    SyncNode();
+    void begin(SyncRole role, uint32_t session);
+    SyncRole getRole() const;
+    uint32_t getSession() const;
+    const ClockOffsetEstimator &getClock() const;
+    bool isClockReady() const;
+    bool getLatestScene(SyncScene &latest) const;
+    uint32_t getLatestSeq() const;
+    uint32_t getLateApplies() const;
+    int64_t getLastLateness() const;
+
+    int64_t frameStartLocal(uint32_t frame) const;
+
+    // Leader: schedules scene SYNC_LEAD_FRAMES frames ahead, returns bytes to multicast
+    size_t publish(const SyncScene &newScene, int64_t now, uint8_t *buf, size_t len);
+    // Leader: re-encodes the latest scene for late joiners, 0 if there is none
+    size_t makeHeartbeat(uint8_t *buf, size_t len) const;
+    // Follower: clock sample request to send to the leader
+    size_t makeTimeRequest(int64_t now, uint8_t *buf, size_t len) const;
+    // Handles a received datagram, returns the size of a reply to send back (0 for none)
+    size_t handleMessage(const uint8_t *data, size_t dataLen, int64_t now, uint8_t *reply, size_t replyLen);
+
+    // Microseconds until the pending scene is due (<= 0 when due), -1 if nothing can be applied yet
+    int64_t pendingDueIn(int64_t now) const;
+    // Hands out the pending scene once due; lateness is how far past its frame start it is
+    bool takeDueScene(int64_t now, SyncScene &due, uint32_t &frame, int64_t &lateness);
+};
+
+#endif
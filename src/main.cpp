@@ -5,12 +5,24 @@
 #include <Preferences.h>
 #include <esp_log.h>
 #include "LedController.h"
+#include "SyncController.h"
+#ifdef USE_STATIC_LED_CONTROLLER
+#include "StaticLedController.h"
+#endif
 
 // Global objects
+#ifdef USE_STATIC_LED_CONTROLLER
+StaticLedController<FigurineLedLayout> ledController;
+#else
 LedController ledController;
+#endif
+SyncController syncController;
 WebServer server(80);
 DNSServer dnsServer;
 Preferences preferences;
+Preferences syncPreferences; // Own namespace so a WiFi reset keeps the sync role
+
+static_assert(ledController.numGroups <= SYNC_MAX_GROUPS, "sync scenes cannot carry this many groups");
 
 // Configuration
 #define RESET_BUTTON_PIN 0
@@ -48,6 +60,11 @@ void handleAllOn();
 void handleAllOff();
 void handleInfo();
 void handleReset();
+void handleSync();
+void handleSyncConfig();
+void startSync();
+SyncScene leaderScene();
+void applySyncScene(const SyncScene &scene);
 void addStatusEntry(const String &action);
 
 void setup()
@@ -65,10 +82,10 @@ void setup()
     ledController.init();
 
     Serial.println("Testing LEDs...");
-    Serial.printf("LED PIN: %d, NUM_LEDS: %d\n", LED_PIN, 4);
+    Serial.printf("LED PIN: %d, NUM_LEDS: %d\n", ledController.ledPin, ledController.numLeds);
 
     // Test each group individually
-    for (int i = 0; i < 4; i++)
+    for (int i = 0; i < ledController.numGroups; i++)
     {
         Serial.printf("Setting group %d to white, brightness 100\n", i);
         ledController.setGroupColor(i, 255, 255, 255);
@@ -88,6 +105,7 @@ void setup()
     preferences.begin("wificonfig", false);
     savedSSID = preferences.getString("ssid", "");
     savedPassword = preferences.getString("password", "");
+    syncPreferences.begin("sync", false);
 
     // Initialize WiFi
     setupWiFi();
@@ -95,6 +113,12 @@ void setup()
     // Setup web server
     setupWebServer();
 
+    // Join the other boards if a sync role is configured
+    if (!isAccessPoint)
+    {
+        startSync();
+    }
+
     Serial.println("Setup complete!");
 }
 
@@ -110,7 +134,7 @@ void loop()
     }
 
     server.handleClient();
-    delay(10);
+    syncController.wait(10);
 }
 
 void setupWiFi()
@@ -167,6 +191,8 @@ void setupWebServer()
     server.on("/api/all/on", HTTP_POST, handleAllOn);
     server.on("/api/all/off", HTTP_POST, handleAllOff);
     server.on("/api/reset", HTTP_POST, handleReset);
+    server.on("/api/sync", HTTP_GET, handleSync);
+    server.on("/api/sync", HTTP_POST, handleSyncConfig);
     server.begin();
     Serial.println("Web server started");
 }
@@ -215,10 +241,13 @@ void handleRoot()
     // JavaScript
     html += "<script>";
     html += "let status={};";
+    // In leader mode a change is applied up to SYNC_LEAD_FRAMES + 1 frames after
+    // the request returns, so status is not reloaded before that
+    html += "const reloadDelay=" + String((SYNC_LEAD_FRAMES + 1) * SYNC_FRAME_US / 1000 + 100) + ";";
     html += "function init(){createGroups();loadStatus();setInterval(loadStatus,3000);}";
     html += "function createGroups(){";
     html += "const container=document.getElementById('groups');";
-    html += "for(let i=0;i<4;i++){";
+    html += "for(let i=0;i<" + String(ledController.numGroups) + ";i++){";
     html += "const div=document.createElement('div');";
     html += "div.className='group';div.id='group'+i;";
     html += "div.innerHTML='<div class=\"group-header\"><h3>Group '+(i+1)+'</h3><button class=\"power-btn off\" onclick=\"toggleGroup('+i+')\" id=\"power'+i+'\"></button></div><div class=\"control-row\"><label>Color:</label><input type=\"color\" class=\"color-input\" id=\"color'+i+'\" onchange=\"updateColor('+i+')\"></div><div class=\"control-row\"><label>Brightness:</label><input type=\"range\" class=\"range-input\" min=\"0\" max=\"255\" id=\"brightness'+i+'\" oninput=\"updateBrightnessDisplay('+i+')\" onchange=\"updateBrightness('+i+')\"><span class=\"brightness-val\" id=\"brightVal'+i+'\">50%</span></div><div class=\"status-text\" id=\"status'+i+'\">OFF</div>';";
@@ -242,15 +271,15 @@ void handleRoot()
     html += "function updateColor(i){const hex=document.getElementById('color'+i).value;const r=parseInt(hex.slice(1,3),16);const g=parseInt(hex.slice(3,5),16);const b=parseInt(hex.slice(5,7),16);sendCommand({group:i,color:{r:r,g:g,b:b}});}";
     html += "function updateBrightnessDisplay(i){const val=parseInt(document.getElementById('brightness'+i).value);const percent=Math.round(val/255*100);document.getElementById('brightVal'+i).textContent=percent+'%';}";
     html += "function updateBrightness(i){const val=parseInt(document.getElementById('brightness'+i).value);const percent=Math.round(val/255*100);document.getElementById('brightVal'+i).textContent=percent+'%';sendCommand({group:i,brightness:val});}";
-    html += "function allOn(){fetch('/api/all/on',{method:'POST'}).then(()=>setTimeout(loadStatus,100));}";
-    html += "function allOff(){fetch('/api/all/off',{method:'POST'}).then(()=>setTimeout(loadStatus,100));}";
+    html += "function allOn(){fetch('/api/all/on',{method:'POST'}).then(()=>setTimeout(loadStatus,reloadDelay));}";
+    html += "function allOff(){fetch('/api/all/off',{method:'POST'}).then(()=>setTimeout(loadStatus,reloadDelay));}";
     html += "function resetWifi(){";
     html += "if(confirm('WARNING: Reset WiFi Settings?\\n\\nThis will:\\n- Clear saved WiFi credentials\\n- Restart the device\\n- Return to setup mode\\n\\nAre you sure?')){";
     html += "if(confirm('FINAL CONFIRMATION:\\n\\nThis action cannot be undone!\\n\\nClick OK to proceed with WiFi reset.')){";
     html += "fetch('/api/reset',{method:'POST'}).then(()=>{alert('WiFi reset initiated! Device restarting in 3 seconds...');});";
     html += "}else{alert('WiFi reset cancelled.');}";
     html += "}else{alert('WiFi reset cancelled.');}}";
-    html += "function sendCommand(data){fetch('/api/group',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(data)}).then(()=>setTimeout(loadStatus,500));}";
+    html += "function sendCommand(data){fetch('/api/group',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(data)}).then(()=>setTimeout(loadStatus,Math.max(500,reloadDelay)));}";
     html += "document.addEventListener('DOMContentLoaded',init);";
     html += "</script></body></html>";
 
@@ -299,6 +328,7 @@ void handleConnect()
         server.send(200, "text/html", html);
         dnsServer.stop();
         isAccessPoint = false;
+        startSync();
     }
     else
     {
@@ -317,6 +347,14 @@ void handleGroup()
     String body = server.arg("plain");
     Serial.printf("handleGroup received: %s\n", body.c_str());
 
+    // In leader mode changes are collected into a scene that every board applies on the same frame
+    bool isLeader = syncController.isLeader();
+    SyncScene scene;
+    if (isLeader)
+    {
+        scene = leaderScene();
+    }
+
     int group = -1;
     bool isOn = false;
     int brightness = -1;
@@ -343,7 +381,15 @@ void handleGroup()
         String isOnStr = body.substring(colonPos + 1, endPos);
         isOnStr.trim();
         isOn = (isOnStr == "true");
-        ledController.setGroupState(group, isOn);
+        if (isLeader)
+        {
+            if (group >= 0 && group < ledController.numGroups)
+                scene.groups[group].isOn = isOn;
+        }
+        else
+        {
+            ledController.setGroupState(group, isOn);
+        }
         addStatusEntry("Group " + String(group + 1) + (isOn ? " turned ON" : " turned OFF"));
     }
 
@@ -355,7 +401,15 @@ void handleGroup()
         int bracePos = body.indexOf('}', colonPos);
         int endPos = (commaPos != -1 && commaPos < bracePos) ? commaPos : bracePos;
         brightness = body.substring(colonPos + 1, endPos).toInt();
-        ledController.setGroupBrightness(group, brightness);
+        if (isLeader)
+        {
+            if (group >= 0 && group < ledController.numGroups)
+                scene.groups[group].brightness = brightness;
+        }
+        else
+        {
+            ledController.setGroupBrightness(group, brightness);
+        }
         addStatusEntry("Group " + String(group + 1) + " brightness: " + String((brightness * 100) / 255) + "%");
     }
 
@@ -375,24 +429,72 @@ void handleGroup()
 
         if (r >= 0 && g >= 0 && b >= 0)
         {
-            ledController.setGroupColor(group, r, g, b);
+            if (isLeader)
+            {
+                if (group >= 0 && group < ledController.numGroups)
+                {
+                    scene.groups[group].r = r;
+                    scene.groups[group].g = g;
+                    scene.groups[group].b = b;
+                }
+            }
+            else
+            {
+                ledController.setGroupColor(group, r, g, b);
+            }
             addStatusEntry("Group " + String(group + 1) + " color changed");
         }
     }
 
+    if (isLeader && group >= 0 && group < ledController.numGroups)
+    {
+        syncController.publish(scene);
+
+        LedGroup scheduled;
+        scheduled.color = CRGB(scene.groups[group].r, scene.groups[group].g, scene.groups[group].b);
+        scheduled.brightness = scene.groups[group].brightness;
+        scheduled.isOn = scene.groups[group].isOn;
+        server.send(200, "application/json", groupStatusJson(group, scheduled));
+        return;
+    }
+
     server.send(200, "application/json", ledController.getGroupStatus(group));
 }
 
 void handleAllOn()
 {
-    ledController.setAllOn();
+    if (syncController.isLeader())
+    {
+        SyncScene scene = leaderScene();
+        for (int i = 0; i < scene.groupCount; i++)
+        {
+            scene.groups[i].isOn = true;
+        }
+        syncController.publish(scene);
+    }
+    else
+    {
+        ledController.setAllOn();
+    }
     addStatusEntry("All groups turned ON");
     server.send(200, "text/plain", "OK");
 }
 
 void handleAllOff()
 {
-    ledController.setAllOff();
+    if (syncController.isLeader())
+    {
+        SyncScene scene = leaderScene();
+        for (int i = 0; i < scene.groupCount; i++)
+        {
+            scene.groups[i].isOn = false;
+        }
+        syncController.publish(scene);
+    }
+    else
+    {
+        ledController.setAllOff();
+    }
     addStatusEntry("All groups turned OFF");
     server.send(200, "text/plain", "OK");
 }
@@ -407,6 +509,82 @@ void handleReset()
     ESP.restart();
 }
 
+void handleSync()
+{
+    server.send(200, "application/json", syncController.getStatus());
+}
+
+void handleSyncConfig()
+{
+    String body = server.arg("plain");
+    Serial.printf("handleSyncConfig received: %s\n", body.c_str());
+
+    int rolePos = body.indexOf("\"role\":");
+    if (rolePos == -1)
+    {
+        server.send(400, "text/plain", "Missing role");
+        return;
+    }
+
+    int startQuote = body.indexOf('"', body.indexOf(':', rolePos) + 1);
+    int endQuote = startQuote == -1 ? -1 : body.indexOf('"', startQuote + 1);
+    SyncRole role;
+    if (endQuote == -1 || !syncRoleFromName(body.substring(startQuote + 1, endQuote), role))
+    {
+        server.send(400, "text/plain", "Role must be leader, follower or off");
+        return;
+    }
+
+    syncPreferences.putUChar("role", role);
+    startSync();
+    addStatusEntry(String("Sync role set to ") + syncRoleName(role));
+
+    server.send(200, "application/json", syncController.getStatus());
+}
+
+void startSync()
+{
+    uint8_t storedRole = syncPreferences.getUChar("role", SYNC_OFF);
+    SyncRole role = storedRole <= SYNC_FOLLOWER ? (SyncRole)storedRole : SYNC_OFF;
+    syncController.begin(role, applySyncScene);
+}
+
+// Scene a leader builds its next change on. Uses the last published scene
+// when there is one, since it may not have been applied to the LEDs yet.
+SyncScene leaderScene()
+{
+    SyncScene scene;
+    if (syncController.getLatestScene(scene))
+    {
+        return scene;
+    }
+
+    scene.groupCount = ledController.numGroups;
+    for (int i = 0; i < ledController.numGroups; i++)
+    {
+        LedGroup group = ledController.getGroup(i);
+        scene.groups[i].r = group.color.r;
+        scene.groups[i].g = group.color.g;
+        scene.groups[i].b = group.color.b;
+        scene.groups[i].brightness = group.brightness;
+        scene.groups[i].isOn = group.isOn;
+    }
+    return scene;
+}
+
+void applySyncScene(const SyncScene &scene)
+{
+    LedGroup states[ledController.numGroups];
+    int count = scene.groupCount < ledController.numGroups ? scene.groupCount : ledController.numGroups;
+    for (int i = 0; i < count; i++)
+    {
+        states[i].color = CRGB(scene.groups[i].r, scene.groups[i].g, scene.groups[i].b);
+        states[i].brightness = scene.groups[i].brightness;
+        states[i].isOn = scene.groups[i].isOn;
+    }
+    ledController.setGroups(states, count);
+}
+
 void addStatusEntry(const String &action)
 {
     statusHistory[statusIndex].action = action;
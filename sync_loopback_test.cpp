@@ -0,0 +1,373 @@
+/*
+ * Sync Loopback Test - runs one leader and several followers as separate
+ * processes on a Linux host, talking the real sync protocol over UDP
+ * multicast on the loopback interface.
+ *
+ * Each node gets its own simulated clock (random offset and drift) so the
+ * followers actually have something to estimate. Every node reports the true
+ * host time at which it applied each scene; the spread across nodes is the
+ * inter-node skew.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=gnu++11 -O2 -Isrc sync_loopback_test.cpp src/SyncProtocol.cpp -o sync_loopback_test
+ *   ./sync_loopback_test [followers] [scenes]
+ *
+ * Host requirements: Linux with multicast enabled on lo (the default; if the
+ * join fails, `ip route add 239.0.0.0/8 dev lo`). Nodes sleep until each
+ * frame start instead of spinning, so one CPU is enough, but wakeup latency
+ * on a loaded or single-CPU host shows up as skew and the odd late scene.
+ * The run passes when at least MIN_IN_FRAME_PERCENT of the scenes reached
+ * every node within one frame; late and missed scenes are reported either way.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <map>
+#include "SyncProtocol.h"
+
+#define MULTICAST_GROUP "239.255.70.76"
+#define SCENE_INTERVAL_US 300000
+#define WARMUP_US 1500000
+#define SETTLE_US 500000
+#define MIN_IN_FRAME_PERCENT 90
+
+struct NodeClock
+{
+    int64_t offset;   // Added to host time
+    double driftPpm;  // Rate error against host time
+};
+
+struct ApplyReport
+{
+    int node;
+    uint32_t frame;
+    int64_t hostTime;
+    int64_t offsetError; // Estimated minus true leader offset, followers only
+    bool late;           // Applied after its frame had ended
+};
+
+static int64_t hostMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleepUntilHost(int64_t host)
+{
+    struct timespec ts;
+    ts.tv_sec = host / 1000000;
+    ts.tv_nsec = (host % 1000000) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+    {
+    }
+}
+
+static int64_t localMicros(const NodeClock &clock, int64_t host)
+{
+    return host + (int64_t)(host * clock.driftPpm / 1e6) + clock.offset;
+}
+
+static int openMulticastReceiver()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SYNC_MULTICAST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind multicast");
+        exit(1);
+    }
+
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(MULTICAST_GROUP);
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+    {
+        perror("join multicast");
+        exit(1);
+    }
+    return fd;
+}
+
+static int openSender()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+
+    struct in_addr iface;
+    iface.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+    unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    return fd;
+}
+
+static void sendMulticast(int fd, const uint8_t *buf, size_t len)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SYNC_MULTICAST_PORT);
+    addr.sin_addr.s_addr = inet_addr(MULTICAST_GROUP);
+    sendto(fd, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static void runNode(int index, SyncRole role, const NodeClock &clock, const NodeClock &leaderClock,
+                    int scenes, int64_t endHost, int reportFd)
+{
+    int mcastFd = openMulticastReceiver();
+    int sendFd = openSender();
+
+    // The default 50us slack would be added to every frame-start wakeup
+    prctl(PR_SET_TIMERSLACK, 1UL);
+
+    SyncNode node;
+    node.begin(role, 0x1000 + index);
+
+    bool hasLeaderAddress = false;
+    struct sockaddr_in leaderAddr;
+    int64_t lastTimeRequest = 0;
+    int64_t lastHeartbeat = 0;
+    int published = 0;
+    int64_t nextPublishHost = hostMicros() + WARMUP_US;
+
+    uint8_t buf[SYNC_MAX_MESSAGE_SIZE];
+    uint8_t reply[SYNC_MAX_MESSAGE_SIZE];
+
+    while (hostMicros() < endHost)
+    {
+        // Same shape as SyncController::wait(): poll in ~1ms steps, then wait out the exact frame start
+        struct pollfd fds[2] = {{mcastFd, POLLIN, 0}, {sendFd, POLLIN, 0}};
+        poll(fds, 2, 1);
+
+        for (int f = 0; f < 2; f++)
+        {
+            if (!(fds[f].revents & POLLIN))
+                continue;
+
+            struct sockaddr_in from;
+            socklen_t fromLen = sizeof(from);
+            ssize_t len = recvfrom(fds[f].fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromLen);
+            if (len <= 0)
+                continue;
+
+            int64_t now = localMicros(clock, hostMicros());
+            size_t replySize = node.handleMessage(buf, len, now, reply, sizeof(reply));
+            if (replySize > 0)
+            {
+                sendto(sendFd, reply, replySize, 0, (struct sockaddr *)&from, fromLen);
+            }
+
+            SyncMessage msg;
+            if (role == SYNC_FOLLOWER && decodeSyncMessage(buf, len, msg) && msg.type == SYNC_MSG_SCENE)
+            {
+                leaderAddr = from;
+                hasLeaderAddress = true;
+            }
+        }
+
+        int64_t host = hostMicros();
+        int64_t now = localMicros(clock, host);
+
+        if (role == SYNC_FOLLOWER && hasLeaderAddress)
+        {
+            int64_t interval = node.getClock().sampleCount() < SYNC_OFFSET_SAMPLES ? SYNC_TIME_REQUEST_FAST_US : SYNC_TIME_REQUEST_US;
+            if (now - lastTimeRequest >= interval)
+            {
+                size_t size = node.makeTimeRequest(now, buf, sizeof(buf));
+                sendto(sendFd, buf, size, 0, (struct sockaddr *)&leaderAddr, sizeof(leaderAddr));
+                lastTimeRequest = now;
+            }
+        }
+        else if (role == SYNC_LEADER)
+        {
+            if (published < scenes && host >= nextPublishHost)
+            {
+                // Alternate all on / all off, like hitting /api/all/on and /api/all/off
+                SyncScene scene;
+                scene.groupCount = 4;
+                for (int i = 0; i < scene.groupCount; i++)
+                {
+                    scene.groups[i].r = 255;
+                    scene.groups[i].g = 255;
+                    scene.groups[i].b = 255;
+                    scene.groups[i].brightness = 128;
+                    scene.groups[i].isOn = published % 2 == 0;
+                }
+                size_t size = node.publish(scene, now, buf, sizeof(buf));
+                sendMulticast(sendFd, buf, size);
+                lastHeartbeat = now;
+                published++;
+                nextPublishHost += SCENE_INTERVAL_US;
+            }
+            else if (now - lastHeartbeat >= SYNC_HEARTBEAT_US)
+            {
+                size_t size = node.makeHeartbeat(buf, sizeof(buf));
+                if (size > 0)
+                    sendMulticast(sendFd, buf, size);
+                lastHeartbeat = now;
+            }
+        }
+
+        int64_t dueIn = node.pendingDueIn(now);
+        if (dueIn >= 0 && dueIn <= 1000)
+        {
+            // Sleep rather than spin: with every node spinning at once a
+            // single CPU cannot run the one whose frame is due. Drift over
+            // the last millisecond is far below a microsecond, so local and
+            // host time advance together here.
+            int64_t remaining;
+            while ((remaining = node.pendingDueIn(localMicros(clock, hostMicros()))) > 0)
+            {
+                sleepUntilHost(hostMicros() + remaining);
+            }
+
+            SyncScene scene;
+            uint32_t frame;
+            int64_t lateness;
+            int64_t appliedHost = hostMicros();
+            if (node.takeDueScene(localMicros(clock, appliedHost), scene, frame, lateness))
+            {
+                ApplyReport report;
+                report.node = index;
+                report.frame = frame;
+                report.hostTime = appliedHost;
+                report.offsetError = 0;
+                report.late = lateness >= SYNC_FRAME_US;
+                if (role == SYNC_FOLLOWER)
+                {
+                    int64_t trueOffset = localMicros(leaderClock, appliedHost) - localMicros(clock, appliedHost);
+                    report.offsetError = node.getClock().offset() - trueOffset;
+                }
+                write(reportFd, &report, sizeof(report));
+            }
+        }
+    }
+
+    close(mcastFd);
+    close(sendFd);
+}
+
+int main(int argc, char **argv)
+{
+    int followers = argc > 1 ? atoi(argv[1]) : 3;
+    int scenes = argc > 2 ? atoi(argv[2]) : 20;
+    int nodes = followers + 1;
+
+    srand(time(NULL));
+    std::vector<NodeClock> clocks(nodes);
+    for (int i = 0; i < nodes; i++)
+    {
+        // Boards boot at different times and their crystals run at slightly different rates
+        clocks[i].offset = (int64_t)(rand() % 20000000) - 10000000;
+        clocks[i].driftPpm = (rand() % 41) - 20;
+    }
+
+    int pipeFds[2];
+    if (pipe(pipeFds) < 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+
+    int64_t endHost = hostMicros() + WARMUP_US + (int64_t)scenes * SCENE_INTERVAL_US + SYNC_LEAD_FRAMES * SYNC_FRAME_US + SETTLE_US;
+    printf("Sync loopback test: 1 leader, %d followers, %d scenes\n", followers, scenes);
+
+    for (int i = 0; i < nodes; i++)
+    {
+        printf("  node %d: %-8s offset %+9lld us, drift %+4.0f ppm\n", i, i == 0 ? "leader" : "follower",
+               (long long)clocks[i].offset, clocks[i].driftPpm);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(pipeFds[0]);
+            runNode(i, i == 0 ? SYNC_LEADER : SYNC_FOLLOWER, clocks[i], clocks[0], scenes, endHost, pipeFds[1]);
+            _exit(0);
+        }
+    }
+    close(pipeFds[1]);
+
+    std::map<uint32_t, std::vector<ApplyReport> > byFrame;
+    std::vector<int64_t> worstOffsetError(nodes, 0);
+    int lateApplies = 0;
+    ApplyReport report;
+    while (read(pipeFds[0], &report, sizeof(report)) == sizeof(report))
+    {
+        if (report.late)
+            lateApplies++;
+        byFrame[report.frame].push_back(report);
+        if (llabs(report.offsetError) > worstOffsetError[report.node])
+            worstOffsetError[report.node] = llabs(report.offsetError);
+    }
+    while (wait(NULL) > 0)
+    {
+    }
+
+    int complete = 0;
+    int sameFrame = 0;
+    int64_t totalSkew = 0;
+    int64_t maxSkew = 0;
+    for (std::map<uint32_t, std::vector<ApplyReport> >::iterator it = byFrame.begin(); it != byFrame.end(); ++it)
+    {
+        if ((int)it->second.size() != nodes)
+            continue;
+
+        int64_t first = it->second[0].hostTime;
+        int64_t last = first;
+        for (size_t i = 1; i < it->second.size(); i++)
+        {
+            if (it->second[i].hostTime < first)
+                first = it->second[i].hostTime;
+            if (it->second[i].hostTime > last)
+                last = it->second[i].hostTime;
+        }
+
+        int64_t skew = last - first;
+        complete++;
+        totalSkew += skew;
+        if (skew > maxSkew)
+            maxSkew = skew;
+        if (skew < SYNC_FRAME_US)
+            sameFrame++;
+    }
+
+    printf("Scenes applied on every node: %d/%d (%d missed by at least one node)\n", complete, scenes, scenes - complete);
+    printf("Scenes within one frame (%d us): %d/%d\n", SYNC_FRAME_US, sameFrame, complete);
+    printf("Late applies (after their frame): %d\n", lateApplies);
+    if (complete > 0)
+    {
+        printf("Inter-node skew: mean %lld us, max %lld us\n", (long long)(totalSkew / complete), (long long)maxSkew);
+    }
+    for (int i = 1; i < nodes; i++)
+    {
+        printf("  node %d worst offset estimate error: %lld us\n", i, (long long)worstOffsetError[i]);
+    }
+
+    // A single late wakeup is the host's scheduler, not the protocol, so only a
+    // run where scenes regularly miss their frame counts as a failure
+    bool passed = sameFrame * 100 >= scenes * MIN_IN_FRAME_PERCENT;
+    printf("%s: %d/%d scenes in frame on every node, need %d%%\n", passed ? "PASS" : "FAIL", sameFrame, scenes, MIN_IN_FRAME_PERCENT);
+    return passed ? 0 : 1;
+}